@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <chrono>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware events sampled around every workload.
+enum class PerfEvent {
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    DTLBMisses,
+    BranchMisses,
+    Count
+};
+
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::Count);
+
+struct PerfSample {
+    uint64_t elapsed_ns = 0;
+    std::optional<uint64_t> counters[PERF_EVENT_COUNT];
+
+    std::optional<uint64_t> operator[](PerfEvent event) const {
+        return counters[static_cast<size_t>(event)];
+    }
+};
+
+// Thin wrapper around `perf_event_open`. The first event that opens becomes the group
+// leader and the others join its group, so all counters are started, stopped and scheduled
+// together and cover the same window. An event that cannot be opened (no PMU,
+// `perf_event_paranoid`, containers, non-Linux builds) is left out of the group and reported
+// as missing; with no events at all the sample degrades to wall-clock time only.
+// When the group does not fit the PMU the kernel time-shares it as a whole; counts are then
+// scaled by the group's enabled/running time, and a group that never got scheduled is reported as missing.
+struct PerfCounters {
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool available(PerfEvent event) const;
+    [[nodiscard]] bool any_available() const;
+
+    void start();
+    PerfSample stop();
+
+private:
+    int fds[PERF_EVENT_COUNT];
+    int leader = -1;
+    std::chrono::steady_clock::time_point started;
+};
+
+#if defined(__linux__)
+namespace perf_detail {
+    inline int open_event(uint32_t type, uint64_t config, int group_fd) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group_fd < 0;  // Members follow the leader.
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+
+    inline uint64_t cache_miss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+}
+#endif
+
+inline PerfCounters::PerfCounters() {
+    std::fill(fds, fds + PERF_EVENT_COUNT, -1);
+#if defined(__linux__)
+    auto add = [this](PerfEvent event, uint32_t type, uint64_t config) {
+        auto fd = perf_detail::open_event(type, config, leader);
+        fds[static_cast<size_t>(event)] = fd;
+        if (leader < 0) {
+            leader = fd;
+        }
+    };
+    add(PerfEvent::Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    add(PerfEvent::L1DMisses, PERF_TYPE_HW_CACHE, perf_detail::cache_miss(PERF_COUNT_HW_CACHE_L1D));
+    add(PerfEvent::LLCMisses, PERF_TYPE_HW_CACHE, perf_detail::cache_miss(PERF_COUNT_HW_CACHE_LL));
+    add(PerfEvent::DTLBMisses, PERF_TYPE_HW_CACHE, perf_detail::cache_miss(PERF_COUNT_HW_CACHE_DTLB));
+    add(PerfEvent::BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+}
+
+inline PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (auto fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+inline bool PerfCounters::available(PerfEvent event) const {
+    return fds[static_cast<size_t>(event)] >= 0;
+}
+
+inline bool PerfCounters::any_available() const {
+    return std::any_of(fds, fds + PERF_EVENT_COUNT, [](int fd) { return fd >= 0; });
+}
+
+inline void PerfCounters::start() {
+#if defined(__linux__)
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+    started = std::chrono::steady_clock::now();
+}
+
+inline PerfSample PerfCounters::stop() {
+    auto stopped = std::chrono::steady_clock::now();
+    PerfSample sample;
+#if defined(__linux__)
+    if (leader >= 0) {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // Layout given by `read_format`: nr, time enabled, time running, then one value per
+        // member in the order the members joined, which is the order of the opened fds.
+        uint64_t values[3 + PERF_EVENT_COUNT];
+        auto bytes = read(leader, values, sizeof(values));
+        if (bytes >= static_cast<ssize_t>(3 * sizeof(uint64_t))
+                && bytes >= static_cast<ssize_t>((3 + values[0]) * sizeof(uint64_t)) && values[2] > 0) {
+            uint64_t member = 0;
+            for (size_t i = 0; i < PERF_EVENT_COUNT && member < values[0]; i++) {
+                if (fds[i] >= 0) {
+                    auto value = values[3 + member++];
+                    sample.counters[i] = values[2] < values[1]
+                            ? static_cast<uint64_t>(static_cast<double>(value) * values[1] / values[2])
+                            : value;
+                }
+            }
+        }
+    }
+#endif
+    sample.elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stopped - started).count();
+    return sample;
+}
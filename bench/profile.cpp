@@ -0,0 +1,182 @@
+// Per-operation profiling harness: runs find/insert/erase/scan workloads over a grid of
+// list sizes and block sizes and prints hardware counters normalised per operation as CSV.
+//
+// usage: profile_blocked_skiplist [--sizes 1000,100000] [--block-sizes 64,256]
+//                                 [--ops 1000000] [--workloads find,insert,erase,scan]
+//                                 [--seed 42]
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <functional>
+
+#include "../blocked_skiplist.hpp"
+#include "perf_counters.hpp"
+
+using Key = uint64_t;
+using List = BlockedSkipList<Key, Key>;
+
+struct Config {
+    std::vector<size_t> sizes{1000, 100000, 1000000};
+    std::vector<size_t> block_sizes{64, 128, 256};
+    std::vector<std::string> workloads{"find", "insert", "erase", "scan"};
+    size_t ops = 1000000;
+    uint64_t seed = 42;
+};
+
+template<typename T>
+static std::vector<T> split_list(const std::string& arg, const std::function<T(const std::string&)>& parse) {
+    std::vector<T> res;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            res.push_back(parse(item));
+        }
+    }
+    return res;
+}
+
+static Config parse_args(int argc, char **argv) {
+    Config config;
+    auto to_size = [](const std::string& s) { return static_cast<size_t>(std::stoull(s)); };
+    auto to_string = [](const std::string& s) { return s; };
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--sizes") {
+            config.sizes = split_list<size_t>(value, to_size);
+        } else if (arg == "--block-sizes") {
+            config.block_sizes = split_list<size_t>(value, to_size);
+        } else if (arg == "--workloads") {
+            config.workloads = split_list<std::string>(value, to_string);
+        } else if (arg == "--ops") {
+            config.ops = to_size(value);
+        } else if (arg == "--seed") {
+            config.seed = std::stoull(value);
+        } else {
+            throw std::runtime_error("Unknown argument " + arg);
+        }
+    }
+    for (auto n : config.sizes) {
+        if (n == 0) {
+            throw std::runtime_error("List sizes must be positive");
+        }
+    }
+    // Node::size and Node::capacity are uint16_t.
+    for (auto block_size : config.block_sizes) {
+        if (block_size < 2 || block_size > 32768 || (block_size & (block_size - 1)) != 0) {
+            throw std::runtime_error("Block sizes must be powers of two in [2, 32768], got " + std::to_string(block_size));
+        }
+    }
+    if (config.ops == 0) {
+        throw std::runtime_error("--ops must be positive");
+    }
+    return config;
+}
+
+static std::vector<Key> shuffled_keys(size_t n, std::mt19937_64& rng) {
+    std::vector<Key> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    return keys;
+}
+
+static void fill(List& list, const std::vector<Key>& keys) {
+    for (auto key : keys) {
+        list.insert(key, key);
+    }
+}
+
+// Runs one workload and returns the counters together with the number of operations measured.
+// Setup (building the list, generating probe keys) happens outside of the measured window.
+static std::pair<PerfSample, size_t> run(const std::string& workload, size_t n, size_t block_size,
+                                         const Config& config, PerfCounters& counters, uint64_t& sink) {
+    std::mt19937_64 rng(config.seed);
+    auto keys = shuffled_keys(n, rng);
+    List list(block_size);
+
+    if (workload == "insert") {
+        counters.start();
+        fill(list, keys);
+        return {counters.stop(), n};
+    }
+
+    fill(list, keys);
+    if (workload == "find") {
+        std::uniform_int_distribution<Key> d(0, n - 1);
+        std::vector<Key> probes(config.ops);
+        std::generate(probes.begin(), probes.end(), [&] { return d(rng); });
+        counters.start();
+        for (auto key : probes) {
+            sink += list.find(key)->val;
+        }
+        return {counters.stop(), probes.size()};
+    } else if (workload == "erase") {
+        std::shuffle(keys.begin(), keys.end(), rng);
+        counters.start();
+        for (auto key : keys) {
+            sink += list.erase(key).has_value();
+        }
+        return {counters.stop(), n};
+    } else if (workload == "scan") {
+        size_t passes = std::max<size_t>(1, config.ops / n);
+        counters.start();
+        for (size_t i = 0; i < passes; i++) {
+            for (auto it = list.begin(); it != list.end(); ++it) {
+                sink += it->val;
+            }
+        }
+        return {counters.stop(), passes * n};
+    }
+    throw std::runtime_error("Unknown workload " + workload);
+}
+
+static void print_per_op(std::optional<uint64_t> value, size_t ops) {
+    std::cout << ",";
+    if (value.has_value()) {
+        std::cout << static_cast<double>(*value) / static_cast<double>(ops);
+    }
+}
+
+int main(int argc, char **argv) {
+    Config config;
+    try {
+        config = parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    PerfCounters counters;
+    if (!counters.any_available()) {
+        std::cerr << "Hardware counters unavailable, reporting timing only." << std::endl;
+    }
+
+    uint64_t sink = 0;
+    std::cout << "workload,size,block_size,ops,ns_per_op,instructions_per_op,l1d_misses_per_op,"
+                 "llc_misses_per_op,dtlb_misses_per_op,branch_misses_per_op" << std::endl;
+    for (const auto& workload : config.workloads) {
+        for (auto n : config.sizes) {
+            for (auto block_size : config.block_sizes) {
+                auto [sample, ops] = run(workload, n, block_size, config, counters, sink);
+                std::cout << workload << "," << n << "," << block_size << "," << ops << ","
+                          << static_cast<double>(sample.elapsed_ns) / static_cast<double>(ops);
+                print_per_op(sample[PerfEvent::Instructions], ops);
+                print_per_op(sample[PerfEvent::L1DMisses], ops);
+                print_per_op(sample[PerfEvent::LLCMisses], ops);
+                print_per_op(sample[PerfEvent::DTLBMisses], ops);
+                print_per_op(sample[PerfEvent::BranchMisses], ops);
+                std::cout << std::endl;
+            }
+        }
+    }
+    // Keep the measured loops from being optimised away.
+    std::cerr << "checksum " << sink << std::endl;
+    return 0;
+}
@@ -7,18 +7,21 @@
 #include <stdexcept>
 #include <iostream>
 #include <concepts>
+#include <optional>
+#include <bit>
 
 #define CACHELINE_SIZE 64
 #define NODE_LOWER_BOUND 0.45
+#define NODE_COMPACT_BOUND 0.75
 
 // pre-declaration
-template<typename K, typename V>
+template<typename K, typename V, typename Aug = NoAugment>
 struct BlockedSkipListIterator;
 
-template<typename K, typename V>
+template<typename K, typename V, typename Aug = NoAugment>
 struct BlockedSkipList {
 // Member variables
-    Node<K, V> *head;
+    Node<K, V, Aug> *head;
 public:
     explicit BlockedSkipList();
     explicit BlockedSkipList(size_t block_size);
@@ -30,53 +33,67 @@ public:
     [[nodiscard]] size_t size() const;
     [[nodiscard]] bool empty() const;
 
-    BlockedSkipListIterator<K, V> begin() const;
-    BlockedSkipListIterator<K, V> end() const;
-    BlockedSkipListIterator<K, V> rbegin() const;
-    BlockedSkipListIterator<K, V> rend() const;
+    BlockedSkipListIterator<K, V, Aug> begin() const;
+    BlockedSkipListIterator<K, V, Aug> end() const;
+    BlockedSkipListIterator<K, V, Aug> rbegin() const;
+    BlockedSkipListIterator<K, V, Aug> rend() const;
 
-    BlockedSkipListIterator<K, V> find(K key) const;
-    BlockedSkipListIterator<K, V> insert(Entry<K, V> entry);
-    BlockedSkipListIterator<K, V> insert(K key, V value);
-    BlockedSkipListIterator<K, V> update(Entry<K, V> entry);
-    BlockedSkipListIterator<K, V> update(K key, V value);
+    BlockedSkipListIterator<K, V, Aug> find(K key) const;
+    BlockedSkipListIterator<K, V, Aug> insert(Entry<K, V> entry);
+    BlockedSkipListIterator<K, V, Aug> insert(K key, V value);
+    BlockedSkipListIterator<K, V, Aug> update(Entry<K, V> entry);
+    BlockedSkipListIterator<K, V, Aug> update(K key, V value);
     std::optional<std::pair<K, V>> erase(K key);
+    BlockedSkipListIterator<K, V, Aug> erase(BlockedSkipListIterator<K, V, Aug> first, BlockedSkipListIterator<K, V, Aug> last);
+    size_t erase_range(K lo, K hi);
     void clear();
+    bool compact(size_t budget);
 
-    void merge(BlockedSkipList<K, V>& other);
-    std::pair<BlockedSkipList<K, V>, BlockedSkipList<K, V>> split(K key);
-    std::pair<BlockedSkipList<K, V>, BlockedSkipList<K, V>> split(BlockedSkipListIterator<K, V> iter);
+    typename Aug::value_type reduce(K lo, K hi) const requires(Augmentation<Aug, K, V>);
+
+    void merge(BlockedSkipList<K, V, Aug>& other);
+    std::pair<BlockedSkipList<K, V, Aug>, BlockedSkipList<K, V, Aug>> split(K key);
+    std::pair<BlockedSkipList<K, V, Aug>, BlockedSkipList<K, V, Aug>> split(BlockedSkipListIterator<K, V, Aug> iter);
 
     void print() const;
 
-    V& operator[](K key);
+    V& operator[](K key) requires(!is_augmented_v<Aug>);
+    const V& operator[](K key) const;
 
 private:
     // Member functions
-    Node<K, V> *find_node(Node<K, V> *cur_block, K key, Node<K, V> *level_lower_bound[SKIP_LIST_LEVELS]) const;
-    void merge_node(Node<K, V>* node);
-    void balance_block(Node<K, V> *node);
+    Node<K, V, Aug> *find_node(Node<K, V, Aug> *cur_block, K key, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const;
+    void find_predecessors(Node<K, V, Aug> *node, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const;
+    void merge_node(Node<K, V, Aug>* node);
+    size_t erase_blocks(K lo, std::optional<K> hi);
+    void balance_block(Node<K, V, Aug> *node);
     [[nodiscard]] size_t get_random_level() const;
     [[nodiscard]] size_t get_node_lower_bound() const;
+    [[nodiscard]] size_t get_node_compact_bound() const;
+    bool rebalance_tower(Node<K, V, Aug> *node, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const;
+    void refresh_aggregates(Node<K, V, Aug> *node);
+    void refresh_aggregates(Node<K, V, Aug> *node, Node<K, V, Aug> *const level_lower_bound[SKIP_LIST_LEVELS]);
 
     size_t m_size;
     size_t block_size;
+    std::optional<K> m_compact_cursor;  // min key of the block the next compact() call resumes from
+    size_t m_compact_index;  // position of that block in the list, used to pick its tower height
     const float p = 0.5;    // probability of a node having a level
     static std::mt19937 level_generator;
 };
 
-template<typename K, typename V>
-std::mt19937 BlockedSkipList<K, V>::level_generator = std::mt19937(std::random_device{}());
+template<typename K, typename V, typename Aug>
+std::mt19937 BlockedSkipList<K, V, Aug>::level_generator = std::mt19937(std::random_device{}());
 
-template<typename K, typename V>
+template<typename K, typename V, typename Aug>
 struct BlockedSkipListIterator {
-    Node<K, V> *node;
+    Node<K, V, Aug> *node;
     size_t index;
     bool forward = true;
 
     BlockedSkipListIterator() = default;
-    BlockedSkipListIterator(Node<K, V> *node, size_t index): node(node), index(index) {}
-    BlockedSkipListIterator(Node<K, V> *node, size_t index, bool forward): node(node), index(index), forward(forward) {}
+    BlockedSkipListIterator(Node<K, V, Aug> *node, size_t index): node(node), index(index) {}
+    BlockedSkipListIterator(Node<K, V, Aug> *node, size_t index, bool forward): node(node), index(index), forward(forward) {}
 
     void change_direction() {
         forward = !forward;
@@ -126,36 +143,39 @@ struct BlockedSkipListIterator {
         return *this;
     }
 
-    Entry<K, V>& operator*() {
+    // Entries of augmented lists are read-only, their values must be changed through update().
+    using entry_type = std::conditional_t<is_augmented_v<Aug>, const Entry<K, V>, Entry<K, V>>;
+
+    entry_type& operator*() {
         return node->data[index];
     }
 
-    Entry<K, V>* operator->() {
+    entry_type* operator->() {
         return &node->data[index];
     }
 };
 
 // Template Class
-template<typename K, typename V>
-BlockedSkipList<K, V>::BlockedSkipList(): block_size(256) {
+template<typename K, typename V, typename Aug>
+BlockedSkipList<K, V, Aug>::BlockedSkipList(): m_size(0), block_size(256), m_compact_index(0) {
     // check if the block_size is the power of 2
     if ((block_size & (block_size - 1)) != 0) {
         throw std::runtime_error("Block m_size must be a power of 2");
     }
-    head = new Node<K, V>(block_size);
+    head = new Node<K, V, Aug>(block_size);
 }
 
-template<typename K, typename V>
-BlockedSkipList<K, V>::BlockedSkipList(size_t block_size): block_size(block_size) {
+template<typename K, typename V, typename Aug>
+BlockedSkipList<K, V, Aug>::BlockedSkipList(size_t block_size): m_size(0), block_size(block_size), m_compact_index(0) {
     // check if the block_size is the power of 2
     if ((block_size & (block_size - 1)) != 0) {
         throw std::runtime_error("Block m_size must be a power of 2");
     }
-    head = new Node<K, V>(block_size);
+    head = new Node<K, V, Aug>(block_size);
 }
 
-template<typename K, typename V>
-BlockedSkipList<K, V>::~BlockedSkipList() {
+template<typename K, typename V, typename Aug>
+BlockedSkipList<K, V, Aug>::~BlockedSkipList() {
     auto cur = head;
     while (cur != nullptr) {
         auto next = cur->forward[0];
@@ -164,22 +184,23 @@ BlockedSkipList<K, V>::~BlockedSkipList() {
     }
 }
 
-template<typename K, typename V>
-BlockedSkipList<K, V>::BlockedSkipList(const BlockedSkipList& other) requires(std::copyable<K> && std::copyable<V>) {
+template<typename K, typename V, typename Aug>
+BlockedSkipList<K, V, Aug>::BlockedSkipList(const BlockedSkipList& other) requires(std::copyable<K> && std::copyable<V>) {
     block_size = other.block_size;
-    head = new Node<K, V>(block_size);
+    head = new Node<K, V, Aug>(block_size);
     m_size = 0;
+    m_compact_index = 0;
     for (auto it = other.begin(); it != other.end(); ++it) {
         insert(*it);
     }
 }
 
-template<typename K, typename V>
-BlockedSkipList<K, V>& BlockedSkipList<K, V>::operator=(const BlockedSkipList& other) requires(std::copyable<K> && std::copyable<V>) {
+template<typename K, typename V, typename Aug>
+BlockedSkipList<K, V, Aug>& BlockedSkipList<K, V, Aug>::operator=(const BlockedSkipList& other) requires(std::copyable<K> && std::copyable<V>) {
     if (this != &other) {
         clear();
         block_size = other.block_size;
-        head = new Node<K, V>(block_size);
+        head = new Node<K, V, Aug>(block_size);
         m_size = 0;
         for (auto it = other.begin(); it != other.end(); ++it) {
             insert(*it);
@@ -188,28 +209,28 @@ BlockedSkipList<K, V>& BlockedSkipList<K, V>::operator=(const BlockedSkipList& o
     return *this;
 }
 
-template<typename K, typename V>
-size_t BlockedSkipList<K, V>::size() const {
-    return size;
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::size() const {
+    return m_size;
 }
 
-template<typename K, typename V>
-bool BlockedSkipList<K, V>::empty() const {
+template<typename K, typename V, typename Aug>
+bool BlockedSkipList<K, V, Aug>::empty() const {
     return m_size == 0;
 }
 
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::begin() const {
-    return BlockedSkipListIterator<K, V>(head, 0);
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::begin() const {
+    return BlockedSkipListIterator<K, V, Aug>(head, 0);
 }
 
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::end() const {
-    return BlockedSkipListIterator<K, V>(nullptr, 0);
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::end() const {
+    return BlockedSkipListIterator<K, V, Aug>(nullptr, 0);
 }
 
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::rbegin() const {
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::rbegin() const {
     auto it = begin();
     while (it.node->forward[0] != nullptr) {
         it.node = it.node->forward[0];
@@ -219,13 +240,13 @@ BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::rbegin() const {
     return it;
 }
 
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::rend() const {
-    return BlockedSkipListIterator<K, V>(nullptr, 0, false);
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::rend() const {
+    return BlockedSkipListIterator<K, V, Aug>(nullptr, 0, false);
 }
 
-template<typename K, typename V>
-size_t BlockedSkipList<K, V>::get_random_level() const {
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::get_random_level() const {
     std::uniform_real_distribution<double> d(0.0, 1.0);
     auto level = 1;
     while (d(level_generator) < p && level < SKIP_LIST_LEVELS) {
@@ -234,8 +255,19 @@ size_t BlockedSkipList<K, V>::get_random_level() const {
     return level;
 }
 
-template<typename K, typename V>
-V& BlockedSkipList<K, V>::operator[](K key) {
+/// Not available on augmented lists, whose values must be changed through update().
+template<typename K, typename V, typename Aug>
+V& BlockedSkipList<K, V, Aug>::operator[](K key) requires(!is_augmented_v<Aug>) {
+    auto entry = find(key);
+    if (entry != end()) {
+        return (*entry).val;
+    } else {
+        throw std::runtime_error("Key not found");
+    }
+}
+
+template<typename K, typename V, typename Aug>
+const V& BlockedSkipList<K, V, Aug>::operator[](K key) const {
     auto entry = find(key);
     if (entry != end()) {
         return (*entry).val;
@@ -245,14 +277,16 @@ V& BlockedSkipList<K, V>::operator[](K key) {
 }
 
 /// @return the iterator to the inserted element
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::insert(Entry<K, V> entry) {
-    Node<K, V> *blocks_per_level[SKIP_LIST_LEVELS];
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::insert(Entry<K, V> entry) {
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
     auto target_node = find_node(head, entry.key, blocks_per_level);
 
     // The node is full
     if (target_node->size == block_size) {
-        auto *new_node = new Node<K, V>();
+        Node<K, V, Aug> *target_lower_bound[SKIP_LIST_LEVELS];
+        std::copy(blocks_per_level, blocks_per_level + SKIP_LIST_LEVELS, target_lower_bound);
+        auto *new_node = new Node<K, V, Aug>(block_size);
         target_node->split_into(new_node);
 
         // Insert new target_node into the skip list at level 0.
@@ -277,33 +311,47 @@ BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::insert(Entry<K, V> entry) {
                 blocks_per_level[l] = new_node;
             } else {
                 new_node->forward[l] = nullptr;
+                if (blocks_per_level[l]->forward[l] == target_node) {
+                    blocks_per_level[l] = target_node;
+                }
             }
         }
+        blocks_per_level[0] = target_node;
+        refresh_aggregates(target_node, target_lower_bound);
+        refresh_aggregates(new_node, blocks_per_level);
 
         // Recall
         return insert(entry);
     } else {
         auto iter = target_node->insert(entry);
-        balance_block(target_node);
         m_size += 1;
-        return BlockedSkipListIterator<K, V>(target_node, iter - target_node->data);
+        refresh_aggregates(target_node, blocks_per_level);
+        if (target_node->size < get_node_lower_bound()) {
+            // Balancing may move the entry into another block or free `target_node`.
+            balance_block(target_node);
+            return find(entry.key);
+        }
+        return BlockedSkipListIterator<K, V, Aug>(target_node, iter - target_node->data);
     }
 }
 
 /// @return the iterator to the inserted element
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::insert(K key, V value) {
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::insert(K key, V value) {
     return insert(Entry<K, V>(key, value));
 }
 
 /// Update the value of the key if it exists, otherwise insert the key-value pair.
 /// @return the iterator to the inserted element
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::update(Entry<K, V> entry) {
-    auto iter = find(entry.key);
-    if (iter != end()) {
-        (*iter).val = entry.val;
-        return iter;
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::update(Entry<K, V> entry) {
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+    auto target_node = find_node(head, entry.key, blocks_per_level);
+    auto pos = target_node->find(entry.key);
+    if (pos != nullptr) {
+        pos->val = entry.val;
+        refresh_aggregates(target_node, blocks_per_level);
+        return BlockedSkipListIterator<K, V, Aug>(target_node, pos - target_node->data);
     } else {
         return insert(entry);
     }
@@ -311,26 +359,147 @@ BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::update(Entry<K, V> entry) {
 
 /// Update the value of the key if it exists, otherwise insert the key-value pair.
 /// @return the iterator to the inserted element
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::update(K key, V value) {
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::update(K key, V value) {
     return update(Entry<K, V>(key, value));
 }
 
 /// @return the erased key-value pair, otherwise return end()
-template<typename K, typename V>
-std::optional<std::pair<K, V>> BlockedSkipList<K, V>::erase(K key) {
-    Node<K, V> *blocks_per_level[SKIP_LIST_LEVELS];
+template<typename K, typename V, typename Aug>
+std::optional<std::pair<K, V>> BlockedSkipList<K, V, Aug>::erase(K key) {
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
     auto target_node = find_node(head, key, blocks_per_level);
     auto entry = target_node->erase(key);
     if (entry.has_value()) {
+        refresh_aggregates(target_node, blocks_per_level);
         balance_block(target_node);
         m_size -= 1;
     }
     return entry;
 }
 
-template<typename K, typename V>
-void BlockedSkipList<K, V>::clear() {
+/// Erase all elements in [first, last).
+/// @return the iterator to the element following the erased ones
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::erase(BlockedSkipListIterator<K, V, Aug> first, BlockedSkipListIterator<K, V, Aug> last) {
+    if (first == last || first == end()) {
+        return last;
+    }
+    if (last == end()) {
+        erase_blocks(first->key, std::nullopt);
+        return end();
+    }
+    auto hi = last->key;
+    erase_blocks(first->key, hi);
+    return find(hi);
+}
+
+/// Erase all elements whose key lies in [lo, hi).
+/// @return the number of erased elements
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::erase_range(K lo, K hi) {
+    return erase_blocks(lo, hi);
+}
+
+/// Erase all keys in [lo, hi), or [lo, +inf) if `hi` is empty. Only the two boundary blocks are trimmed,
+/// blocks fully covered by the range are unlinked from every level and freed without touching their elements.
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::erase_blocks(K lo, std::optional<K> hi) {
+    if (head == nullptr || (hi.has_value() && !(lo < *hi))) {
+        return 0;
+    }
+
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+    auto first = find_node(head, lo, blocks_per_level);
+    if (first != head) {
+        // Now blocks_per_level[l] is the last block before `first` on level l.
+        blocks_per_level[0] = first->prev;
+    }
+
+    // 1. Trim `first`.
+    auto from = std::lower_bound(first->data, first->data + first->size, lo);
+    auto to = hi.has_value() ? std::lower_bound(from, first->data + first->size, *hi) : first->data + first->size;
+    auto ends_inside = to != first->data + first->size;
+    size_t erased = to - from;
+    std::move(to, first->data + first->size, from);
+    first->size -= erased;
+    if (ends_inside) {
+        // The range ends inside `first`, its max_key is untouched.
+        m_size -= erased;
+        refresh_aggregates(first, blocks_per_level);
+        balance_block(first);
+        return erased;
+    }
+    if (first->size > 0) {
+        first->m_max_key = first->data[first->size - 1].key;
+    }
+
+    // 2. Unlink and free the covered blocks. `first` goes as well if nothing is left in it.
+    auto unlink = [&blocks_per_level](Node<K, V, Aug> *node) {
+        for (auto l = 0; l < SKIP_LIST_LEVELS; l++) {
+            if (blocks_per_level[l]->forward[l] == node) {
+                blocks_per_level[l]->forward[l] = node->forward[l];
+            }
+        }
+    };
+    auto left = first;
+    auto last = first->forward[0];
+    if (first->size == 0 && first != head) {
+        left = blocks_per_level[0];
+        unlink(first);
+        delete first;
+    } else {
+        for (auto l = 0; l < SKIP_LIST_LEVELS; l++) {
+            if (blocks_per_level[l]->forward[l] == first) {
+                blocks_per_level[l] = first;
+            }
+        }
+    }
+    while (last != nullptr && (!hi.has_value() || last->max_key() < *hi)) {
+        auto next = last->forward[0];
+        erased += last->size;
+        unlink(last);
+        delete last;
+        last = next;
+    }
+
+    // 3. Trim `last`, the range cannot cover it completely.
+    if (last != nullptr) {
+        last->prev = left;
+        auto keep = std::lower_bound(last->data, last->data + last->size, *hi);
+        std::move(keep, last->data + last->size, last->data);
+        erased += keep - last->data;
+        last->size -= keep - last->data;
+    }
+    m_size -= erased;
+
+    // 4. Rebalance the two blocks left at the boundary.
+    if (last != nullptr && (left->size < get_node_lower_bound() || last->size < get_node_lower_bound()) &&
+        left->size + last->size <= block_size) {
+        std::move(last->data, last->data + last->size, left->data + left->size);
+        left->size += last->size;
+        left->m_max_key = left->data[left->size - 1].key;
+        unlink(last);
+        if (left->forward[0] != nullptr) {
+            left->forward[0]->prev = left;
+        }
+        delete last;
+        last = nullptr;
+    }
+    refresh_aggregates(left, blocks_per_level);
+    if (last != nullptr) {
+        refresh_aggregates(last, blocks_per_level);
+    }
+    if (left->size < get_node_lower_bound()) {
+        balance_block(left);
+    } else if (last != nullptr && last->size < get_node_lower_bound()) {
+        balance_block(last);
+    }
+    return erased;
+}
+
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::clear() {
     auto cur = head;
     while (cur != nullptr) {
         auto next = cur->forward[0];
@@ -339,18 +508,20 @@ void BlockedSkipList<K, V>::clear() {
     }
     head = nullptr;
     m_size = 0;
+    m_compact_cursor.reset();
+    m_compact_index = 0;
 }
 
-template<typename K, typename V>
-void BlockedSkipList<K, V>::merge(BlockedSkipList<K, V>& other) {
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::merge(BlockedSkipList<K, V, Aug>& other) {
     for (auto it = other.begin(); it != other.end(); ++it) {
         insert(*it);
     }
     other.clear();
 }
 
-template<typename K, typename V>
-Node<K, V>* BlockedSkipList<K, V>::find_node(Node<K, V> *cur_block, K key, Node<K, V> *level_lower_bound[SKIP_LIST_LEVELS]) const {
+template<typename K, typename V, typename Aug>
+Node<K, V, Aug>* BlockedSkipList<K, V, Aug>::find_node(Node<K, V, Aug> *cur_block, K key, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const {
     for (int l = SKIP_LIST_LEVELS - 1; 0 <= l; l--) {
         while (cur_block->forward[l] != nullptr && cur_block->forward[l]->max_key() < key &&
                cur_block->forward[l]->forward[0] != nullptr) {
@@ -361,26 +532,169 @@ Node<K, V>* BlockedSkipList<K, V>::find_node(Node<K, V> *cur_block, K key, Node<
     return level_lower_bound[0]->forward[0] != nullptr && level_lower_bound[0]->max_key() < key ? level_lower_bound[0]->forward[0] : level_lower_bound[0];
 }
 
-template<typename K, typename V>
-BlockedSkipListIterator<K, V> BlockedSkipList<K, V>::find(K key) const {
+/// Find the last block before `node` on every level. `node` must not be the head.
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::find_predecessors(Node<K, V, Aug> *node, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const {
+    if (node->size > 0) {
+        find_node(head, node->min_key(), level_lower_bound);
+        return;
+    }
+    // An empty block has no key to search for, go through the block before it instead.
+    auto prev_node = node->prev;
+    find_node(head, prev_node->max_key(), level_lower_bound);
+    for (auto l = 0; l < SKIP_LIST_LEVELS; l++) {
+        if (level_lower_bound[l]->forward[l] == prev_node) {
+            level_lower_bound[l] = prev_node;
+        }
+    }
+}
+
+template<typename K, typename V, typename Aug>
+BlockedSkipListIterator<K, V, Aug> BlockedSkipList<K, V, Aug>::find(K key) const {
     if (head != nullptr) {
-        Node<K, V> *blocks[SKIP_LIST_LEVELS];
+        Node<K, V, Aug> *blocks[SKIP_LIST_LEVELS];
         auto block = find_node(head, key, blocks);
         auto entry = block->find(key);
         if (entry != nullptr) {
-            return BlockedSkipListIterator<K, V>(block, entry - block->data);
+            return BlockedSkipListIterator<K, V, Aug>(block, entry - block->data);
         }
     }
     return end();
 }
 
-template<typename K, typename V>
-size_t BlockedSkipList<K, V>::get_node_lower_bound() const {
-    return static_cast<size_t>(NODE_LOWER_BOUND * block_size);
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::get_node_lower_bound() const {
+    // At least 1, so that an emptied block is always merged away even for tiny blocks.
+    return std::max<size_t>(1, static_cast<size_t>(NODE_LOWER_BOUND * block_size));
+}
+
+template<typename K, typename V, typename Aug>
+size_t BlockedSkipList<K, V, Aug>::get_node_compact_bound() const {
+    return static_cast<size_t>(NODE_COMPACT_BOUND * block_size);
 }
 
-template<typename K, typename V>
-void BlockedSkipList<K, V>::balance_block(Node<K, V> *node) {
+/// Repack under-filled blocks and move tower heights towards a balanced distribution.
+/// At most `budget` blocks are visited per call; the next call resumes where this one stopped,
+/// so a full pass can be spread over many small slices.
+/// @return true if this call finished a full pass over the list
+template<typename K, typename V, typename Aug>
+bool BlockedSkipList<K, V, Aug>::compact(size_t budget) {
+    if (head == nullptr) {
+        return true;
+    }
+
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+    auto cur = head;
+    std::fill(blocks_per_level, blocks_per_level + SKIP_LIST_LEVELS, head);
+    // Rebalance the tower of `node`, refreshing the links it gained or lost.
+    auto rebalance = [this, &blocks_per_level](Node<K, V, Aug> *node) {
+        Node<K, V, Aug> *prev_lower_bound[SKIP_LIST_LEVELS];
+        std::copy(blocks_per_level, blocks_per_level + SKIP_LIST_LEVELS, prev_lower_bound);
+        if (rebalance_tower(node, blocks_per_level)) {
+            refresh_aggregates(node->prev, prev_lower_bound);
+            refresh_aggregates(node, blocks_per_level);
+        }
+    };
+    if (m_compact_cursor.has_value()) {
+        cur = find_node(head, *m_compact_cursor, blocks_per_level);
+        if (cur == head) {
+            m_compact_index = 0;
+        } else {
+            rebalance(cur);
+        }
+    } else {
+        m_compact_index = 0;
+    }
+
+    auto target_size = get_node_compact_bound();
+    while (budget > 0) {
+        budget--;
+        auto next_node = cur->forward[0];
+        if (next_node == nullptr) {
+            m_compact_cursor.reset();
+            m_compact_index = 0;
+            return true;
+        }
+
+        if (cur->size < target_size) {
+            auto size_to_move = std::min<size_t>(target_size - cur->size, next_node->size);
+            if (next_node->size - size_to_move < get_node_lower_bound()) {
+                // Do not leave `next_node` under-filled: drain it if it fits, otherwise stop at the lower bound.
+                if (cur->size + next_node->size <= block_size) {
+                    size_to_move = next_node->size;
+                } else {
+                    size_to_move = next_node->size > get_node_lower_bound() ? next_node->size - get_node_lower_bound() : 0;
+                }
+            }
+            // 1. Move the first elements of `next_node` to the end of `cur`.
+            std::move(next_node->data, next_node->data + size_to_move, cur->data + cur->size);
+            // 2. Move the rest of the elements in `next_node` to the beginning.
+            std::move(next_node->data + size_to_move, next_node->data + next_node->size, next_node->data);
+            // 3. Update the size and max_key of `cur`.
+            cur->size += size_to_move;
+            next_node->size -= size_to_move;
+            cur->m_max_key = cur->data[cur->size - 1].key;
+
+            if (next_node->size == 0) {
+                // `next_node` is drained, remove it from the skiplist and keep filling `cur`.
+                for (auto l = 0; l < SKIP_LIST_LEVELS; l++) {
+                    if (blocks_per_level[l]->forward[l] == next_node) {
+                        blocks_per_level[l]->forward[l] = next_node->forward[l];
+                    }
+                }
+                if (next_node->forward[0] != nullptr) {
+                    next_node->forward[0]->prev = cur;
+                }
+                delete next_node;
+                refresh_aggregates(cur, blocks_per_level);
+                continue;
+            }
+            refresh_aggregates(cur, blocks_per_level);
+            refresh_aggregates(next_node, blocks_per_level);
+        }
+
+        cur = next_node;
+        m_compact_index += 1;
+        rebalance(cur);
+    }
+
+    if (cur == head) {
+        m_compact_cursor.reset();
+    } else {
+        m_compact_cursor = cur->min_key();
+    }
+    return false;
+}
+
+/// Give `node` the height it would have in a perfectly balanced skip list: one extra level for every
+/// power of two dividing its position. `level_lower_bound[l]` must be the last block on level l before
+/// `node`, and is advanced to `node` on every level `node` ends up on.
+/// @return true if the tower of `node` changed
+template<typename K, typename V, typename Aug>
+bool BlockedSkipList<K, V, Aug>::rebalance_tower(Node<K, V, Aug> *node, Node<K, V, Aug> *level_lower_bound[SKIP_LIST_LEVELS]) const {
+    auto height = std::min<size_t>(std::countr_zero(m_compact_index) + 1, SKIP_LIST_LEVELS);
+    auto changed = false;
+    for (uint l = 1; l < SKIP_LIST_LEVELS; l++) {
+        auto linked = level_lower_bound[l]->forward[l] == node;
+        if (l < height && !linked) {
+            node->forward[l] = level_lower_bound[l]->forward[l];
+            level_lower_bound[l]->forward[l] = node;
+            changed = true;
+        } else if (l >= height && linked) {
+            level_lower_bound[l]->forward[l] = node->forward[l];
+            node->forward[l] = nullptr;
+            changed = true;
+        }
+        if (l < height) {
+            level_lower_bound[l] = node;
+        }
+    }
+    level_lower_bound[0] = node;
+    return changed;
+}
+
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::balance_block(Node<K, V, Aug> *node) {
     // To few elements
     if (node->size < get_node_lower_bound()) {
         auto prev_node = node->prev;
@@ -416,6 +730,9 @@ void BlockedSkipList<K, V>::balance_block(Node<K, V> *node) {
                 another->size -= size_to_move;
                 // 4. Update the max_key
                 node->m_max_key = node->data[node->size - 1].key;
+                // 5. Update the aggregates
+                refresh_aggregates(node);
+                refresh_aggregates(another);
             } else {
                 // 1. Move the elements in `node` backward to make space for the elements in `another`.
                 std::move_backward(node->data, node->data + node->size, node->data + node->size + size_to_move);
@@ -426,14 +743,17 @@ void BlockedSkipList<K, V>::balance_block(Node<K, V> *node) {
                 another->size -= size_to_move;
                 // 4. Update the max_key
                 another->m_max_key = another->data[another->size - 1].key;
+                // 5. Update the aggregates
+                refresh_aggregates(another);
+                refresh_aggregates(node);
             }
         }
     }
 }
 
 
-template<typename K, typename V>
-void BlockedSkipList<K, V>::merge_node(Node<K, V> *node) {
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::merge_node(Node<K, V, Aug> *node) {
     auto prev_node = node->prev;
     auto next_node = node->forward[0];
 
@@ -460,18 +780,20 @@ void BlockedSkipList<K, V>::merge_node(Node<K, V> *node) {
             }
 
             delete node;
+            refresh_aggregates(prev_node);
         }
         merge_node(prev_node);
     } else {  // We are dealing with a middle node, we merge it into the smaller neighbour.
-        Node<K, V> *predecessors[SKIP_LIST_LEVELS];
+        Node<K, V, Aug> *predecessors[SKIP_LIST_LEVELS];
         // Find predecessors, that needs to happen prev moving the elements
-        find_node(head, node->min_key(), predecessors);
+        find_predecessors(node, predecessors);
 
         // First, we move all elements out of the node in question.
-        if (next_node->size < prev_node->size) {
+        auto into_next = next_node->size < prev_node->size;
+        if (into_next) {
             assert(next_node->size + node->size <= block_size && "The caller ensures this node can be merged.");
             // 1. Move all elements in `next_node` backward to make space for the elements in `node`.
-            std::move_backward(next_node->data, next_node->data + next_node->size, next_node->data + node->size);
+            std::move_backward(next_node->data, next_node->data + next_node->size, next_node->data + next_node->size + node->size);
             // 2. Move all elements from `node` to `next_node`.
             std::move(node->data, node->data + node->size, next_node->data);
             // 3. Update the m_size of `next_node`.
@@ -496,11 +818,98 @@ void BlockedSkipList<K, V>::merge_node(Node<K, V> *node) {
         next_node->prev = prev_node;
 
         delete node;
+        refresh_aggregates(prev_node);
+        if (into_next) {
+            refresh_aggregates(next_node);
+        }
+    }
+}
+
+/// Recompute the aggregate of `node` and of every skip link that passes over it, bottom-up.
+/// Callers refresh each block whose elements or links they changed, and the block before a removed one.
+/// Searches for the predecessors of `node`, prefer the overload below when they are at hand.
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::refresh_aggregates(Node<K, V, Aug> *node) {
+    if constexpr (is_augmented_v<Aug>) {
+        Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+        if (node == head) {
+            std::fill(blocks_per_level, blocks_per_level + SKIP_LIST_LEVELS, head);
+        } else {
+            find_predecessors(node, blocks_per_level);
+        }
+        refresh_aggregates(node, blocks_per_level);
+    }
+}
+
+/// `level_lower_bound[l]` must be `node` or the last block before it on level l.
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::refresh_aggregates(Node<K, V, Aug> *node, Node<K, V, Aug> *const level_lower_bound[SKIP_LIST_LEVELS]) {
+    if constexpr (is_augmented_v<Aug>) {
+        node->refresh_aggregate();
+
+        // The last block at or before `node` on each level owns the link passing over it.
+        Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+        for (auto l = 0; l < SKIP_LIST_LEVELS; l++) {
+            blocks_per_level[l] = level_lower_bound[l]->forward[l] == node ? node : level_lower_bound[l];
+        }
+
+        for (auto l = 1; l < SKIP_LIST_LEVELS; l++) {
+            auto block = blocks_per_level[l];
+            auto res = Aug::identity();
+            for (auto cur = block; cur != block->forward[l]; cur = cur->forward[l - 1]) {
+                res = Aug::combine(res, cur->aggregate.link[l - 1]);
+            }
+            block->aggregate.link[l] = res;
+        }
+    }
+}
+
+/// Fold `Aug` over all elements whose key lies in [lo, hi). Only the two boundary blocks are scanned,
+/// the blocks in between are covered by O(log n) link aggregates.
+/// Values must be changed through insert()/update(), writes through iterators or operator[] are not tracked.
+template<typename K, typename V, typename Aug>
+typename Aug::value_type BlockedSkipList<K, V, Aug>::reduce(K lo, K hi) const requires(Augmentation<Aug, K, V>) {
+    auto res = Aug::identity();
+    if (head == nullptr || !(lo < hi)) {
+        return res;
+    }
+
+    // 1. The block holding `lo`.
+    Node<K, V, Aug> *blocks_per_level[SKIP_LIST_LEVELS];
+    auto block = find_node(head, lo, blocks_per_level);
+    auto pos = std::lower_bound(block->data, block->data + block->size, lo);
+    for (; pos != block->data + block->size && pos->key < hi; ++pos) {
+        res = Aug::combine(res, Aug::lift(pos->key, pos->val));
+    }
+    if (pos != block->data + block->size) {
+        return res;
+    }
+
+    // 2. Follow the highest link that does not skip past `hi`.
+    block = block->forward[0];
+    while (block != nullptr) {
+        auto l = SKIP_LIST_LEVELS - 1;
+        while (0 <= l && (block->forward[l] == nullptr || hi < block->forward[l]->min_key())) {
+            l--;
+        }
+        if (l < 0) {
+            break;
+        }
+        res = Aug::combine(res, block->aggregate.link[l]);
+        block = block->forward[l];
+    }
+
+    // 3. The block holding `hi`.
+    if (block != nullptr) {
+        for (pos = block->data; pos != block->data + block->size && pos->key < hi; ++pos) {
+            res = Aug::combine(res, Aug::lift(pos->key, pos->val));
+        }
     }
+    return res;
 }
 
-template<typename K, typename V>
-void BlockedSkipList<K, V>::print() const {
+template<typename K, typename V, typename Aug>
+void BlockedSkipList<K, V, Aug>::print() const {
     auto cur = head;
     while (cur != nullptr) {
         for (int i = 0; i < cur->size; i++) {
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <concepts>
+#include <type_traits>
+
+// An augmentation is a monoid over the entries of the list:
+//   value_type                  the aggregate type
+//   identity()                  the neutral element
+//   lift(key, val)              the aggregate of a single entry
+//   combine(lhs, rhs)           associative, `lhs` covers smaller keys than `rhs`
+// Every block keeps the aggregate of its entries and every skip link the aggregate of the blocks it skips,
+// so `BlockedSkipList::reduce()` can fold a key range in O(log n).
+
+// The default: no aggregates are stored or maintained.
+struct NoAugment {
+    using value_type = void;
+};
+
+template<typename Aug, typename K, typename V>
+concept Augmentation = requires(const K& key, const V& val, const typename Aug::value_type& agg) {
+    { Aug::identity() } -> std::convertible_to<typename Aug::value_type>;
+    { Aug::lift(key, val) } -> std::convertible_to<typename Aug::value_type>;
+    { Aug::combine(agg, agg) } -> std::convertible_to<typename Aug::value_type>;
+};
+
+template<typename Aug>
+constexpr bool is_augmented_v = !std::is_same_v<Aug, NoAugment>;
+
+template<typename K, typename V>
+struct SumAugment {
+    using value_type = V;
+
+    static V identity() { return V{}; }
+    static V lift(const K&, const V& val) { return val; }
+    static V combine(const V& lhs, const V& rhs) { return lhs + rhs; }
+};
+
+template<typename K, typename V>
+struct MinAugment {
+    using value_type = V;
+
+    static V identity() { return std::numeric_limits<V>::max(); }
+    static V lift(const K&, const V& val) { return val; }
+    static V combine(const V& lhs, const V& rhs) { return std::min(lhs, rhs); }
+};
+
+template<typename K, typename V>
+struct MaxAugment {
+    using value_type = V;
+
+    static V identity() { return std::numeric_limits<V>::lowest(); }
+    static V lift(const K&, const V& val) { return val; }
+    static V combine(const V& lhs, const V& rhs) { return std::max(lhs, rhs); }
+};
+
+template<typename K, typename V>
+struct CountAugment {
+    using value_type = size_t;
+
+    static size_t identity() { return 0; }
+    static size_t lift(const K&, const V&) { return 1; }
+    static size_t combine(size_t lhs, size_t rhs) { return lhs + rhs; }
+};
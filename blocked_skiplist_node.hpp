@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <algorithm>
 #include <optional>
+#include "blocked_skiplist_augment.hpp"
 
 #define SKIP_LIST_LEVELS 6
 #define CACHELINE_SIZE 64
@@ -39,7 +40,23 @@ struct Entry{
     }
 };
 
+// aligned_alloc() needs the size to be a multiple of the alignment, so small blocks are rounded up to a whole cache line.
 template<typename K, typename V>
+Entry<K, V>* allocate_entries(size_t capacity) {
+    auto bytes = (capacity * sizeof(Entry<K, V>) + CACHELINE_SIZE - 1) / CACHELINE_SIZE * CACHELINE_SIZE;
+    return (Entry<K, V> *) aligned_alloc(CACHELINE_SIZE, bytes);
+}
+
+// link[l] is the aggregate of the blocks from this one up to (excluding) forward[l], link[0] covers this block only.
+template<typename Aug>
+struct LinkAggregates {
+    typename Aug::value_type link[SKIP_LIST_LEVELS];
+};
+
+template<>
+struct LinkAggregates<NoAugment> {};
+
+template<typename K, typename V, typename Aug = NoAugment>
 struct Node {
     // Header zone
     K m_max_key;
@@ -47,6 +64,7 @@ struct Node {
     uint16_t capacity;  // Number of elements that can be stored in this block.
     Node *forward[SKIP_LIST_LEVELS];  // A fixed number of pointers for all levels.
     Node *prev;
+    [[no_unique_address]] LinkAggregates<Aug> aggregate;  // Only maintained by the list, see refresh_aggregate().
 
     // Data zone
     Entry<K, V> *data;
@@ -68,18 +86,22 @@ struct Node {
     void clear();
     Entry<K, V>* find(K key) const;
     void split_into(Node *other);
+    void refresh_aggregate();
 };
 
-template<typename K, typename V>
-void Node<K, V>::clear() {
+template<typename K, typename V, typename Aug>
+void Node<K, V, Aug>::clear() {
     size = 0;
     m_max_key = 0;
     std::fill(data, data + capacity, Entry<K, V>());
     std::fill(forward, forward + SKIP_LIST_LEVELS, nullptr);
+    if constexpr (is_augmented_v<Aug>) {
+        std::fill(aggregate.link, aggregate.link + SKIP_LIST_LEVELS, Aug::identity());
+    }
 }
 
-template<typename K, typename V>
-Entry<K, V>* Node<K, V>::find(K key) const {
+template<typename K, typename V, typename Aug>
+Entry<K, V>* Node<K, V, Aug>::find(K key) const {
     auto pos = std::lower_bound(data, data + size, key);
     if (pos == data + size || pos->key != key) {
         return nullptr;
@@ -87,29 +109,33 @@ Entry<K, V>* Node<K, V>::find(K key) const {
     return pos;
 }
 
-template<typename K, typename V>
-Node<K, V>::Node(uint64_t block_size): m_max_key{}, size(0), capacity(block_size), prev(nullptr) {
+template<typename K, typename V, typename Aug>
+Node<K, V, Aug>::Node(uint64_t block_size): m_max_key{}, size(0), capacity(block_size), prev(nullptr) {
     // align data to cache line
-    data = (Entry<K, V> *) aligned_alloc(CACHELINE_SIZE, block_size * sizeof(Entry<K, V>));
+    data = allocate_entries<K, V>(block_size);
     std::fill(data, data + capacity, Entry<K, V>());
     std::fill(forward, forward + SKIP_LIST_LEVELS, nullptr);
+    if constexpr (is_augmented_v<Aug>) {
+        std::fill(aggregate.link, aggregate.link + SKIP_LIST_LEVELS, Aug::identity());
+    }
 }
 
-template<typename K, typename V>
-Node<K, V>::Node(const Node& other) requires(std::copyable<K> && std::copyable<V>) {
+template<typename K, typename V, typename Aug>
+Node<K, V, Aug>::Node(const Node& other) requires(std::copyable<K> && std::copyable<V>) {
     // copy header
     m_max_key = other.m_max_key;
     size = other.size;
     capacity = other.capacity;
     prev = other.prev;
     std::copy(other.forward, other.forward + SKIP_LIST_LEVELS, forward);
+    aggregate = other.aggregate;
     // copy data
-    data = (Entry<K, V> *) aligned_alloc(CACHELINE_SIZE, other.capacity * sizeof(Entry<K, V>));
+    data = allocate_entries<K, V>(other.capacity);
     std::copy(other.data, other.data + other.capacity, data);
 }
 
-template<typename K, typename V>
-Node<K, V>& Node<K, V>::operator=(const Node& other) requires(std::copyable<K> && std::copyable<V>) {
+template<typename K, typename V, typename Aug>
+Node<K, V, Aug>& Node<K, V, Aug>::operator=(const Node& other) requires(std::copyable<K> && std::copyable<V>) {
     if (this != &other) {
         // copy header
         m_max_key = other.m_max_key;
@@ -117,41 +143,42 @@ Node<K, V>& Node<K, V>::operator=(const Node& other) requires(std::copyable<K> &
         capacity = other.capacity;
         prev = other.prev;
         std::copy(other.forward, other.forward + SKIP_LIST_LEVELS, forward);
+        aggregate = other.aggregate;
         // copy data
         free(data);
-        data = (Entry<K, V> *) aligned_alloc(CACHELINE_SIZE, other.capacity * sizeof(Entry<K, V>));
+        data = allocate_entries<K, V>(other.capacity);
         std::copy(other.data, other.data + other.capacity, data);
     }
     return *this;
 }
 
-template<typename K, typename V>
-Node<K, V>::~Node() {
+template<typename K, typename V, typename Aug>
+Node<K, V, Aug>::~Node() {
     free(data);
 }
 
-template<typename K, typename V>
-std::pair<K, V> Node<K, V>::min() const {
+template<typename K, typename V, typename Aug>
+std::pair<K, V> Node<K, V, Aug>::min() const {
     return std::make_pair(data[0].key, data[0].val);
 }
 
-template<typename K, typename V>
-std::pair<K, V> Node<K, V>::max() const {
+template<typename K, typename V, typename Aug>
+std::pair<K, V> Node<K, V, Aug>::max() const {
     return std::make_pair(data[size - 1].key, data[size - 1].val);
 }
 
-template<typename K, typename V>
-K Node<K, V>::min_key() const {
+template<typename K, typename V, typename Aug>
+K Node<K, V, Aug>::min_key() const {
     return data[0].key;
 }
 
-template<typename K, typename V>
-K Node<K, V>::max_key() const {
+template<typename K, typename V, typename Aug>
+K Node<K, V, Aug>::max_key() const {
     return m_max_key;
 }
 
-template<typename K, typename V>
-Entry<K, V>* Node<K, V>::insert(K key, V value) {
+template<typename K, typename V, typename Aug>
+Entry<K, V>* Node<K, V, Aug>::insert(K key, V value) {
     // find the position to insert
     auto pos = std::upper_bound(data, data + size, Entry<K, V>(key, value));
     std::move_backward(pos, data + size, data + size + 1);
@@ -162,8 +189,8 @@ Entry<K, V>* Node<K, V>::insert(K key, V value) {
     return pos;
 }
 
-template<typename K, typename V>
-std::optional<std::pair<K, V>> Node<K, V>::erase(K key) {
+template<typename K, typename V, typename Aug>
+std::optional<std::pair<K, V>> Node<K, V, Aug>::erase(K key) {
     auto pos = find(key);
     if (pos == nullptr) {
         return std::nullopt;
@@ -171,12 +198,14 @@ std::optional<std::pair<K, V>> Node<K, V>::erase(K key) {
     auto res = std::make_pair(pos->key, pos->val);
     std::move(pos + 1, data + size, pos);
     size--;
-    m_max_key = data[size - 1].key;
+    if (size > 0) {
+        m_max_key = data[size - 1].key;   // An emptied block keeps its old max_key so searches still pass it in order.
+    }
     return res;
 }
 
-template<typename K, typename V>
-Entry<K, V>* Node<K, V>::insert(Entry<K, V> entry) {
+template<typename K, typename V, typename Aug>
+Entry<K, V>* Node<K, V, Aug>::insert(Entry<K, V> entry) {
     // find the position to insert
     auto pos = std::upper_bound(data, data + size, entry);
     std::move_backward(pos, data + size, data + size + 1);
@@ -188,8 +217,8 @@ Entry<K, V>* Node<K, V>::insert(Entry<K, V> entry) {
 }
 
 // Move half of the elements from this block to the other block.
-template<typename K, typename V>
-void Node<K, V>::split_into(Node *other) {
+template<typename K, typename V, typename Aug>
+void Node<K, V, Aug>::split_into(Node *other) {
     // move
     uint16_t half = size / 2;
     std::move(data + half, data + size, other->data);
@@ -201,3 +230,14 @@ void Node<K, V>::split_into(Node *other) {
     m_max_key = data[size - 1].key;
 }
 
+// Recompute the aggregate of the elements in this block. The aggregates of the skip links are left to the list.
+template<typename K, typename V, typename Aug>
+void Node<K, V, Aug>::refresh_aggregate() {
+    if constexpr (is_augmented_v<Aug>) {
+        auto res = Aug::identity();
+        for (auto pos = data; pos != data + size; ++pos) {
+            res = Aug::combine(res, Aug::lift(pos->key, pos->val));
+        }
+        aggregate.link[0] = res;
+    }
+}
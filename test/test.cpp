@@ -1,4 +1,6 @@
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include "../blocked_skiplist.hpp"
 
@@ -8,12 +10,20 @@ int main() {
         list.insert(i, i);
     }
     std::cout << std::endl;
+    if(list.size() != 1024) {
+        std::cout << "size() is " << list.size() << " after 1024 inserts" << std::endl;
+        return 1;
+    }
     auto list2 = list;
 
     list.print();
     for(int i = 0; i < 1000; i++) {
         auto res = list.erase(i);
     }
+    if(list.size() != 24) {
+        std::cout << "size() is " << list.size() << " after erasing 1000 of 1024 keys" << std::endl;
+        return 1;
+    }
     for(int i = 0; i < 896; i++) {
         std::cout << (list.find(i) != list.end()) << " ";
     }
@@ -25,5 +35,242 @@ int main() {
     list2 = list;
     list.print();
     list2.print();
+
+    // The keys must come back strictly increasing and exactly as expected, in blocks of the list's block size.
+    auto check_keys = [](auto& l, const std::vector<int>& expected, const char *stage) {
+        std::vector<int> keys;
+        for(auto it = l.begin(); it != l.end(); ++it) {
+            keys.push_back(it->key);
+        }
+        for(auto node = l.head; node != nullptr; node = node->forward[0]) {
+            if(node->capacity != l.head->capacity || node->size > node->capacity) {
+                std::cout << "block of " << node->size << "/" << node->capacity << " entries after " << stage << std::endl;
+                return false;
+            }
+        }
+        if(keys != expected || l.size() != expected.size()) {
+            std::cout << "wrong keys after " << stage << std::endl;
+            return false;
+        }
+        for(auto key : expected) {
+            if(l.find(key) == l.end()) {
+                std::cout << "key " << key << " not found after " << stage << std::endl;
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Merging an underfull block into its smaller next block must keep the key order.
+    BlockedSkipList<int, int> list5{8};
+    std::vector<int> expected5;
+    for(int i = 0; i < 40; i++) {
+        list5.insert(i * 10, i * 10);
+        expected5.push_back(i * 10);
+    }
+    list5.insert(45, 45);  // ... [40 45 50 60 70] [80 90 100 110] [120 130 140 150] ...
+    expected5.insert(expected5.begin() + 5, 45);
+    list5.erase(80);  // [90 100 110] is merged into [120 130 140 150]
+    expected5.erase(expected5.begin() + 9);
+    if(!check_keys(list5, expected5, "merging into the next block")) {
+        return 1;
+    }
+
+    // With two entries per block, erase empties non-head blocks before they are merged away.
+    BlockedSkipList<int, int> list6{2};
+    std::vector<int> expected6;
+    for(int i = 0; i < 64; i++) {
+        list6.insert(i, i);
+    }
+    for(int i = 1; i < 64; i += 2) {
+        list6.erase(i);
+    }
+    for(int i = 0; i < 64; i += 2) {
+        expected6.push_back(i);
+    }
+    if(!check_keys(list6, expected6, "emptying blocks")) {
+        return 1;
+    }
+    for(int i = 1; i < 64; i += 2) {
+        if(list6.find(i) != list6.end()) {
+            std::cout << "erased key " << i << " still found" << std::endl;
+            return 1;
+        }
+        list6.insert(i, i);
+    }
+    expected6.clear();
+    for(int i = 0; i < 64; i++) {
+        expected6.push_back(i);
+    }
+    if(!check_keys(list6, expected6, "refilling emptied blocks")) {
+        return 1;
+    }
+
+    BlockedSkipList<int, int> list3{64};
+    for(int i = 0; i < 4096; i++) {
+        list3.insert(i, i);
+    }
+    for(int i = 0; i < 4096; i += 3) {
+        list3.erase(i);
+    }
+    auto count_blocks = [](auto *node) {
+        size_t blocks = 0;
+        for(; node != nullptr; node = node->forward[0]) {
+            blocks++;
+        }
+        return blocks;
+    };
+    auto blocks_before = count_blocks(list3.head);
+    auto size_before = list3.size();
+    while(!list3.compact(8)) {}
+    auto blocks_after = count_blocks(list3.head);
+    std::cout << blocks_before << " -> " << blocks_after << std::endl;
+    if(blocks_after >= blocks_before || list3.size() != size_before) {
+        std::cout << "compact did not repack the list" << std::endl;
+        return 1;
+    }
+    for(int i = 0; i < 4096; i++) {
+        if((list3.find(i) != list3.end()) != (i % 3 != 0)) {
+            std::cout << "compact lost key " << i << std::endl;
+            return 1;
+        }
+    }
+    // After a full pass the block at position i is on level l iff 2^l divides i.
+    size_t index = 0;
+    for(auto node = list3.head; node != nullptr; node = node->forward[0], index++) {
+        for(int l = 1; l < SKIP_LIST_LEVELS; l++) {
+            bool on_level = false;
+            for(auto cur = list3.head; cur != nullptr; cur = cur->forward[l]) {
+                on_level = on_level || cur == node;
+            }
+            if(on_level != (index % (1u << l) == 0)) {
+                std::cout << "compact left an unbalanced tower at block " << index << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // Range erase, checked against a sorted vector of the keys that should be left.
+    auto erase_expected = [](std::vector<int>& expected, int lo, int hi) {
+        auto first = std::lower_bound(expected.begin(), expected.end(), lo);
+        auto last = std::lower_bound(first, expected.end(), hi);
+        auto erased = static_cast<size_t>(last - first);
+        expected.erase(first, last);
+        return erased;
+    };
+    std::vector<int> expected3;
+    for(int i = 0; i < 4096; i++) {
+        if(i % 3 != 0) {
+            expected3.push_back(i);
+        }
+    }
+    auto erased3 = list3.erase_range(100, 4000);
+    std::cout << erased3 << std::endl;
+    if(erased3 != 2600 || erased3 != erase_expected(expected3, 100, 4000) || !check_keys(list3, expected3, "erase_range")) {
+        std::cout << "erase_range(100, 4000) erased " << erased3 << " keys" << std::endl;
+        return 1;
+    }
+    auto next3 = list3.erase(list3.find(4001), list3.find(4090));
+    erase_expected(expected3, 4001, 4090);
+    if(next3 == list3.end() || next3->key != 4090 || !check_keys(list3, expected3, "erase(first, last)")) {
+        std::cout << "erase(first, last) did not stop at 4090" << std::endl;
+        return 1;
+    }
+    if(list3.erase_range(50, 50) != 0 || list3.erase_range(60, 40) != 0 || list3.erase(next3, next3) != next3 ||
+       !check_keys(list3, expected3, "erasing empty ranges")) {
+        std::cout << "an empty range erased keys" << std::endl;
+        return 1;
+    }
+    if(list3.erase(list3.find(4093), list3.end()) != list3.end() || erase_expected(expected3, 4093, 4096) != 2 ||
+       !check_keys(list3, expected3, "erase(first, end())")) {
+        std::cout << "erase(first, end()) did not erase the tail" << std::endl;
+        return 1;
+    }
+    for(auto it = list3.begin(); it != list3.end(); ++it) {
+        std::cout << it->key << " ";
+    }
+    std::cout << std::endl;
+
+    // The branches of range erase on a known layout: [0 .. 30] [40 .. 70] ... [280 .. 310] [320 .. 390]
+    BlockedSkipList<int, int> list7{8};
+    std::vector<int> expected7;
+    for(int i = 0; i < 40; i++) {
+        list7.insert(i * 10, i * 10);
+        expected7.push_back(i * 10);
+    }
+    struct RangeCase {
+        int lo, hi;
+        const char *stage;
+    };
+    for(auto [lo, hi, stage] : {
+            RangeCase{41, 61, "a range ending inside its first block"},
+            RangeCase{120, 200, "a range emptying its first block"},
+            RangeCase{205, 275, "a range whose boundary blocks are merged"},
+            RangeCase{-5, 5, "a range starting in the head block"}}) {
+        auto erased = list7.erase_range(lo, hi);
+        if(erased != erase_expected(expected7, lo, hi) || !check_keys(list7, expected7, stage)) {
+            return 1;
+        }
+    }
+    for(int key : {281, 282, 283, 284, 301, 302, 303}) {
+        list7.insert(key, key);
+        expected7.insert(std::lower_bound(expected7.begin(), expected7.end(), key), key);
+    }
+    // [283 .. 310] keeps 7 keys and [320 .. 390] keeps 2, too many to merge so they are only rebalanced.
+    if(list7.erase_range(305, 380) != erase_expected(expected7, 305, 380) ||
+       !check_keys(list7, expected7, "a range whose boundary blocks are rebalanced")) {
+        return 1;
+    }
+
+    BlockedSkipList<int, int, SumAugment<int, int>> list4{64};
+    // reduce() must agree with a plain scan over the same key range.
+    auto check_reduce = [&list4](const char *stage) {
+        for(int lo = 0; lo < 4200; lo += 337) {
+            for(int hi : {lo, lo + 1, lo + 63, lo + 500, 4200}) {
+                int expected = 0;
+                for(auto it = list4.begin(); it != list4.end(); ++it) {
+                    if(it->key >= lo && it->key < hi) {
+                        expected += it->val;
+                    }
+                }
+                if(list4.reduce(lo, hi) != expected) {
+                    std::cout << "reduce(" << lo << ", " << hi << ") is wrong after " << stage << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    // Scattered insertion order leaves blocks of uneven fill, so erase below can borrow as well as merge.
+    for(int i = 0; i < 4096; i++) {
+        list4.insert(i * 1237 % 4096, i * 1237 % 4096);
+    }
+    if(!check_reduce("insert")) {
+        return 1;
+    }
+    // Thin out every other run of blocks, checking along the way before later erases touch the same blocks again.
+    for(int i = 0; i < 4096; i++) {
+        if((i / 512) % 2 == 0 && i % 8 != 0) {
+            list4.erase(i);
+        }
+        if(i % 64 == 63 && !check_reduce("erase")) {
+            return 1;
+        }
+    }
+    for(int i = 0; i < 4096; i += 24) {
+        list4.update(i, -i);
+    }
+    if(!check_reduce("update")) {
+        return 1;
+    }
+    list4.erase_range(1000, 2000);
+    if(!check_reduce("erase_range")) {
+        return 1;
+    }
+    while(!list4.compact(4)) {}
+    if(!check_reduce("compact")) {
+        return 1;
+    }
+    std::cout << list4.reduce(0, 4096) << " " << list4.reduce(500, 2500) << std::endl;
     return 0;
 }